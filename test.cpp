@@ -25,6 +25,9 @@
  *    g++ -std=c++20 -c -o unittest.o unittest.cpp
  *    g++ -std=c++20 -o test test.o unittest.o
  *
+ * Or as a single translation unit using:
+ *    g++ -std=c++20 -DUNITTEST_HEADER_ONLY -o test_header test.cpp
+ *
  * Test using:
  *    ./test 6 6 6
  *    ./test 6 6
@@ -35,6 +38,7 @@
  */
 
 #include <iostream>
+#include <sstream>
 
 #include "unittest.h"
 
@@ -129,6 +133,100 @@ UNIT_TEST(test12, "Dummy Test 2 affected by argv[3].")
 
 END_TEST
 
+/**
+ * @section failing only test selection.
+ */
+UNIT_TEST(test13, "Test reading results, including the older format without a group.")
+
+    UnitTest_c::Result result{};
+    REQUIRE(UnitTest_c::parseResult("1 test4 test3", result))
+    REQUIRE(result == UnitTest_c::Result("test4", "test3", 1))
+    REQUIRE(UnitTest_c::parseResult("2 test12", result))
+    REQUIRE(result == UnitTest_c::Result("test12", "test12", 2))
+    REQUIRE(!UnitTest_c::parseResult("", result))
+
+NEXT_CASE(test14, "Test storing results in the format that is read back.")
+
+    std::ostringstream os{};
+    UnitTest_c::storeResult(os, UnitTest_c::Result("test4", "test3", 1));
+    REQUIRE(os.str() == "1 test4 test3\n")
+    REQUIRE(UnitTest_c::parseResult(os.str(), result))
+    REQUIRE(result == UnitTest_c::Result("test4", "test3", 1))
+
+NEXT_CASE(test15, "Test selecting previously failing and new test cases.")
+
+    const UnitTest_c::Results results{ { "test3", "test3", 0 }, { "test4", "test3", 1 }, { "test5", "test5", 0 } };
+    REQUIRE(UnitTest_c::isSelected("test3", results))
+    REQUIRE(!UnitTest_c::isSelected("test5", results))
+    REQUIRE(UnitTest_c::isSelected("test13", results))
+
+    const UnitTest_c::Results passed{ { "test3", "test3", 0 }, { "test5", "test5", 0 } };
+    REQUIRE(UnitTest_c::isSelected("test5", passed))
+
+NEXT_CASE(test16, "Test carrying forward the results of skipped test cases.")
+
+    const auto skips{UnitTest_c::getSkipped(results, { "test3" })};
+    REQUIRE(skips.size() == 2)
+    REQUIRE(std::get<0>(skips[0]) == "test3")
+    REQUIRE(std::get<0>(skips[1]) == "test4")
+    REQUIRE(UnitTest_c::getSkipped(results, std::vector<std::string>()).empty())
+
+END_TEST
+
+/**
+ * @section stable timings.
+ */
+UNIT_TEST(test17, "Test reading timings, with and without an environment.")
+
+    const std::string env{"model=Test_CPU;cpu=2;governor=performance;turbo=off"};
+    UnitTest_c::Timing timing{};
+    REQUIRE(UnitTest_c::parseTiming("1200 test3", timing))
+    REQUIRE(timing == UnitTest_c::Timing("test3", std::chrono::nanoseconds(1200), "", ""))
+    REQUIRE(UnitTest_c::parseTiming("1200 test3 " + env + " 0.50", timing))
+    REQUIRE(timing == UnitTest_c::Timing("test3", std::chrono::nanoseconds(1200), env, "0.50"))
+    REQUIRE(!UnitTest_c::parseTiming("test3", timing))
+
+NEXT_CASE(test18, "Test storing timings in the format that is read back.")
+
+    std::ostringstream os{};
+    const UnitTest_c::Timing stable("test3", std::chrono::nanoseconds(1200), env, "0.50");
+    UnitTest_c::storeTiming(os, stable);
+    REQUIRE(os.str() == "1200 test3 " + env + " 0.50\n")
+    REQUIRE(UnitTest_c::parseTiming(os.str(), timing))
+    REQUIRE(timing == stable)
+
+    os.str("");
+    UnitTest_c::storeTiming(os, UnitTest_c::Timing("test3", std::chrono::nanoseconds(1200), "", ""));
+    REQUIRE(os.str() == "1200 test3\n")
+
+NEXT_CASE(test19, "Test timings from different environments are kept apart.")
+
+    REQUIRE(UnitTest_c::getKey("test3", "") == "test3")
+    REQUIRE(UnitTest_c::getKey("test3", env) != UnitTest_c::getKey("test3", ""))
+    REQUIRE(UnitTest_c::getKey("test3", env) != UnitTest_c::getKey("test3", "model=Other_CPU;cpu=2;governor=performance;turbo=off"))
+
+NEXT_CASE(test20, "Test building the environment fingerprint without pinning.")
+
+    REQUIRE(UnitTest_c::getEnvironment(-1).starts_with("model="))
+    REQUIRE(UnitTest_c::getEnvironment(-1).find(";cpu=unpinned;governor=") != std::string::npos)
+    REQUIRE(UnitTest_c::getEnvironment(2).find(";cpu=2;") != std::string::npos)
+    REQUIRE(UnitTest_c::getEnvironment(2).find(' ') == std::string::npos)
+
+END_TEST
+
+/**
+ * @section warm-up.
+ */
+static int warmUps{};
+
+UNIT_TEST(test21, "Test the warm-up run is not recorded - requires WARM_UP_ON.")
+
+    // Fails on the warm-up run, which must not count as an error.
+    ++warmUps;
+    REQUIRE(warmUps == 2)
+
+END_TEST
+
 int runTests(void)
 {
     std::cout << "Executing all tests.\n";
@@ -141,6 +239,12 @@ int runTests(void)
     RUN_TEST(test8)
     RUN_TEST(test10)
     RUN_TEST(test12)
+    RUN_TEST(test13)
+    RUN_TEST(test17)
+
+    WARM_UP_ON
+    RUN_TEST(test21)
+    WARM_UP_OFF
 
     const int err{FINISHED};
     OUTPUT_SUMMARY;
@@ -162,6 +266,13 @@ int main(int argc, char *argv[])
     for (int a{1}; a < argc; ++a)
         dummyValues[a] = atoi(argv[a]);
 
-    return (runTests()==1 ? 0 : 1);
+    // With assertions disabled, the forced error in test4 is not counted.
+#if defined(UNITTEST_DISABLE)
+    const int expected{0};
+#else
+    const int expected{1};
+#endif
+
+    return (runTests()==expected ? 0 : 1);
 }
 
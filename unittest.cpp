@@ -23,37 +23,19 @@
 
 #include <iostream>
 #include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <cctype>
 
 #include "unittest.h"
 
-const std::string timingsFileName{"timings.txt"};
-const std::string profileFileName{"profile.txt"};
-const std::string resultsFileName{"results.txt"};
-const std::string logTestText{"logTest"};
-
-std::string UnitTest_c::testCase{"UNDEFINED"};
-std::string UnitTest_c::description{"UNDEFINED"};
-std::string UnitTest_c::condition{"UNDEFINED"};
-bool UnitTest_c::update{};
-bool UnitTest_c::verbose{true};
-bool UnitTest_c::profiling{true};
-size_t UnitTest_c::errors{};
-float UnitTest_c::tolerance{DEFAULT_TOLERANCE};
-
-std::chrono::time_point<std::chrono::steady_clock> UnitTest_c::start{};
-
-std::unordered_map<std::string, std::chrono::nanoseconds> UnitTest_c::times{};
-std::unordered_map<std::string, size_t> UnitTest_c::counts{};
-std::unordered_map<std::string, size_t> UnitTest_c::errorList{};
-std::vector<std::pair<std::string, std::string>> UnitTest_c::assertList{};
-
 
 /**
  * Send the current name-value pairs to the output stream.
  *
  * @param  os - Output stream.
  */
-void UnitTest_c::display(std::ostream &os) const
+UNITTEST_INLINE void UnitTest_c::display(std::ostream &os) const
 {
     os << "\tTest Case:\t" << testCase << "()\n";
     os << "\tDescription:\t" << description << "\n";
@@ -61,14 +43,21 @@ void UnitTest_c::display(std::ostream &os) const
     os << "\tVerbose:\t" << std::boolalpha << verbose << "\n";
     os << "\tCurrent Errors:\t" << errors << "\n";
     os << "\tTolerance:\t" << (int)(tolerance * 100)<< "%\n";
+    os << "\tStable:\t\t" << std::boolalpha << stable << "\n";
+    if (stable)
+        os << "\tEnvironment:\t" << environment << "\n";
 }
 
-void UnitTest_c::progress(const std::string & test, const std::string & desc)
+UNITTEST_INLINE void UnitTest_c::progress(const std::string & test, const std::string & desc)
 {
     testCase = test;
     description = desc;
 
+    if (warming)
+        return;
+
     errorList[testCase] = 0;
+    groups[testCase] = group.empty() ? testCase : group;
     assertList.emplace_back(testCase, logTestText);
 
     if (verbose)
@@ -77,22 +66,28 @@ void UnitTest_c::progress(const std::string & test, const std::string & desc)
     start = std::chrono::steady_clock::now();
 }
 
-bool UnitTest_c::store(void)
+UNITTEST_INLINE bool UnitTest_c::store(void)
 {
     if (std::ofstream os{timingsFileName, std::ios::out})
     {
         std::cout << "Generating test timings in text file " << timingsFileName << "\n";
 
-        // Output in assertList order.
+        // Output in assertList order, carrying forward skipped test cases.
         for (auto & [testCase, condition] : assertList)
+        {
             if (condition.compare(logTestText) == 0)
-                os << times[testCase].count() << ' ' << testCase << '\n';
+                storeTimes(os, testCase);
+            else
+            if (condition.compare(skipTestText) == 0)
+                for (auto & [func, grp, count] : getSkipped(previous, { testCase }))
+                    storeTimes(os, func);
+        }
     }
 
     return true;
 }
 
-bool UnitTest_c::retrieve(void)
+UNITTEST_INLINE bool UnitTest_c::retrieve(void)
 {
     bool success{true};
 
@@ -103,16 +98,27 @@ bool UnitTest_c::retrieve(void)
     }
     else
     {
-        int64_t time{};
-        std::string func{};
+        std::string line{};
+        Timing timing{};
 
-        while (infile >> time >> func)
-            if (!infile.eof() && func.length())
-                setTime(func, std::chrono::nanoseconds{time});
+        while (std::getline(infile, line))
+        {
+            if (!parseTiming(line, timing))
+                continue;
+
+            const auto & [func, time, env, load] = timing;
+            const auto key{getKey(func, env)};
+            if (setTime(key, time))
+            {
+                environments[key] = env;
+                loads[key] = load;
+            }
+        }
 
         infile.close();
     }
 
+#if !defined(UNITTEST_DISABLE)
     infile.open(resultsFileName, std::ifstream::in);
     if (!infile.is_open())
     {
@@ -120,20 +126,26 @@ bool UnitTest_c::retrieve(void)
     }
     else
     {
-        size_t count{};
-        std::string func{};
+        std::string line{};
+        Result result{};
 
-        while (infile >> count >> func)
-            if (!infile.eof() && func.length())
-                setCount(func, count);
+        while (std::getline(infile, line))
+        {
+            if (!parseResult(line, result))
+                continue;
+
+            setCount(std::get<0>(result), std::get<2>(result));
+            previous.push_back(result);
+        }
 
         infile.close();
     }
+#endif
 
     return success;
 }
 
-std::chrono::nanoseconds UnitTest_c::getTime(const std::string & key)
+UNITTEST_INLINE std::chrono::nanoseconds UnitTest_c::getTime(const std::string & key)
 {
     auto it = times.find(key);
     if (it == times.end())
@@ -142,7 +154,7 @@ std::chrono::nanoseconds UnitTest_c::getTime(const std::string & key)
     return it->second;
 }
 
-bool UnitTest_c::setTime(const std::string & key, std::chrono::nanoseconds value)
+UNITTEST_INLINE bool UnitTest_c::setTime(const std::string & key, std::chrono::nanoseconds value)
 {
     auto it = times.find(key);
     if (it == times.end())
@@ -155,7 +167,322 @@ bool UnitTest_c::setTime(const std::string & key, std::chrono::nanoseconds value
     return false;
 }
 
-bool UnitTest_c::setCount(const std::string & key, size_t count)
+/**
+ * Parse a line of "timings.txt".
+ *
+ * @param  line - "time func", or "time func environment load" in stable mode.
+ * @param  timing - parsed timing.
+ * @return true if the line was parsed successfully.
+ */
+UNITTEST_INLINE bool UnitTest_c::parseTiming(const std::string & line, Timing & timing)
+{
+    std::istringstream iss{line};
+    int64_t time{};
+    std::string func{};
+    std::string env{};
+    std::string load{};
+
+    if (!(iss >> time >> func))
+        return false;
+
+    // Only timings recorded in stable mode have an environment.
+    iss >> env >> load;
+    timing = Timing{func, std::chrono::nanoseconds{time}, env, load};
+
+    return true;
+}
+
+/**
+ * Send a timing to the output stream in the format read by parseTiming().
+ *
+ * @param  os - Output stream.
+ * @param  timing - timing to send.
+ */
+UNITTEST_INLINE void UnitTest_c::storeTiming(std::ostream &os, const Timing & timing)
+{
+    const auto & [func, time, env, load] = timing;
+
+    os << time.count() << ' ' << func;
+    if (!env.empty())
+        os << ' ' << env << ' ' << (load.empty() ? "unknown" : load);
+
+    os << '\n';
+}
+
+/**
+ * Get the key of a timing. Each environment has its own baseline, so timings
+ * from different environments are never compared.
+ *
+ * @param  test - name of the test case.
+ * @param  env - environment fingerprint, empty if not in stable mode.
+ * @return the key used to hold the timing.
+ */
+UNITTEST_INLINE std::string UnitTest_c::getKey(const std::string & test, const std::string & env)
+{
+    if (env.empty())
+        return test;
+
+    return test + ' ' + env;
+}
+
+/**
+ * Send the timings of a test case, from every environment, to the output
+ * stream.
+ *
+ * @param  os - Output stream.
+ * @param  test - name of the test case.
+ */
+UNITTEST_INLINE void UnitTest_c::storeTimes(std::ostream &os, const std::string & test)
+{
+    std::vector<std::string> keys{};
+    for (auto & [key, time] : times)
+        if ((key.compare(test) == 0) || (key.starts_with(test + ' ')))
+            keys.push_back(key);
+
+    std::sort(keys.begin(), keys.end());
+    for (auto & key : keys)
+        storeTiming(os, Timing{test, times[key], environments[key], loads[key]});
+}
+
+/**
+ * Associate the current environment and load average with the timing of a
+ * test case.
+ *
+ * @param  key - name of the test case.
+ */
+UNITTEST_INLINE void UnitTest_c::recordEnvironment(const std::string & key)
+{
+    environments[key] = environment;
+
+    if (!stable)
+    {
+        loads[key].clear();
+        return;
+    }
+
+    const auto load{readValue("/proc/loadavg")};
+    loads[key] = load.empty() ? "unknown" : load;
+}
+
+/**
+ * Read the first word of a (typically /proc or /sys) file.
+ *
+ * @param  fileName - name of the file to read.
+ * @return the first word or an empty string if it could not be read.
+ */
+UNITTEST_INLINE std::string UnitTest_c::readValue(const std::string & fileName)
+{
+    std::string value{};
+
+    if (std::ifstream infile{fileName, std::ifstream::in})
+        infile >> value;
+
+    return value;
+}
+
+/**
+ * Get the CPU model, as a single word.
+ *
+ * @return the CPU model or "unknown".
+ */
+UNITTEST_INLINE std::string UnitTest_c::getModel(void)
+{
+    std::string model{"unknown"};
+
+    if (std::ifstream infile{"/proc/cpuinfo", std::ifstream::in})
+    {
+        std::string line{};
+        while (std::getline(infile, line))
+        {
+            if (line.starts_with("model name"))
+            {
+                const auto pos = line.find(": ");
+                if (pos != std::string::npos)
+                    model = line.substr(pos + 2);
+                break;
+            }
+        }
+    }
+
+    // The fingerprint is stored as a single word in the timings file.
+    std::replace_if(model.begin(), model.end(), [](char c) { return std::isspace(static_cast<unsigned char>(c)); }, '_');
+
+    return model;
+}
+
+/**
+ * Get the CPU frequency governor of a core.
+ *
+ * @param  core - the core, or -1 for the first core.
+ * @return the governor or "unknown".
+ */
+UNITTEST_INLINE std::string UnitTest_c::getGovernor(int core)
+{
+    const std::string cpu{"/sys/devices/system/cpu/cpu" + std::to_string(core < 0 ? 0 : core)};
+
+    const auto governor{readValue(cpu + "/cpufreq/scaling_governor")};
+
+    return governor.empty() ? "unknown" : governor;
+}
+
+/**
+ * Get the CPU turbo state.
+ *
+ * @return "on", "off" or "unknown".
+ */
+UNITTEST_INLINE std::string UnitTest_c::getTurbo(void)
+{
+    if (const auto noTurbo = readValue("/sys/devices/system/cpu/intel_pstate/no_turbo"); !noTurbo.empty())
+        return (noTurbo.compare("1") == 0) ? "off" : "on";
+
+    if (const auto boost = readValue("/sys/devices/system/cpu/cpufreq/boost"); !boost.empty())
+        return (boost.compare("1") == 0) ? "on" : "off";
+
+    return "unknown";
+}
+
+/**
+ * Get the environment fingerprint used to qualify the timings.
+ *
+ * @param  core - the core the test thread is pinned to, or -1 if unpinned.
+ * @return the fingerprint, as a single word.
+ */
+UNITTEST_INLINE std::string UnitTest_c::getEnvironment(int core)
+{
+    std::string env{"model=" + getModel()};
+    env += ";cpu=" + (core < 0 ? std::string{"unpinned"} : std::to_string(core));
+    env += ";governor=" + getGovernor(core);
+    env += ";turbo=" + getTurbo();
+
+    return env;
+}
+
+/**
+ * Pin the test thread to a single core, saving the original affinity. The
+ * core is taken from UNITTEST_CPU, then the first isolated core, then the
+ * lowest core in the original affinity, so that it is the same every run.
+ *
+ * @return the core pinned to, or -1 if the thread could not be pinned.
+ */
+UNITTEST_INLINE int UnitTest_c::pin(void)
+{
+#if defined(__linux__)
+    int core{-1};
+
+    if (const char * value = std::getenv("UNITTEST_CPU"))
+    {
+        char * end{};
+        const auto cpu = std::strtol(value, &end, 10);
+        if ((end == value) || (*end != '\0') || (cpu < 0) || (cpu >= CPU_SETSIZE))
+            std::cerr << "\nIgnoring invalid UNITTEST_CPU value \"" << value << "\"\n";
+        else
+            core = (int)cpu;
+    }
+
+    // The isolated cores are listed as "2-3,5", so take the first number.
+    if (core < 0)
+    {
+        const auto isolated{readValue("/sys/devices/system/cpu/isolated")};
+        if (!isolated.empty())
+            core = (int)std::strtol(isolated.c_str(), nullptr, 10);
+    }
+
+    if (!affinitySaved)
+        affinitySaved = (sched_getaffinity(0, sizeof(originalAffinity), &originalAffinity) == 0);
+
+    if ((core < 0) && (affinitySaved))
+    {
+        for (int cpu{}; cpu < CPU_SETSIZE; ++cpu)
+        {
+            if (CPU_ISSET(cpu, &originalAffinity))
+            {
+                core = cpu;
+                break;
+            }
+        }
+    }
+
+    if ((core < 0) || (core >= CPU_SETSIZE))
+        return -1;
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(core, &set);
+    if (sched_setaffinity(0, sizeof(set), &set) != 0)
+    {
+        std::cerr << "\nUnable to pin the test thread to core " << core << "\n";
+        return -1;
+    }
+
+    return core;
+#else
+    return -1;
+#endif
+}
+
+/**
+ * Restore the affinity the test thread had before it was pinned.
+ */
+UNITTEST_INLINE void UnitTest_c::unpin(void)
+{
+#if defined(__linux__)
+    if (!affinitySaved)
+        return;
+
+    if (sched_setaffinity(0, sizeof(originalAffinity), &originalAffinity) != 0)
+        std::cerr << "\nUnable to restore the test thread affinity\n";
+
+    affinitySaved = false;
+#endif
+}
+
+/**
+ * Turn stable timings on or off. Turning it on pins the test thread to a core
+ * and builds the environment fingerprint used to qualify the timings. Turning
+ * it off restores the original affinity.
+ *
+ * @param  state - true to turn stable timings on.
+ */
+UNITTEST_INLINE void UnitTest_c::setStable(bool state)
+{
+    stable = state;
+    if (!stable)
+    {
+        unpin();
+        environment.clear();
+        return;
+    }
+
+    const int core{pin()};
+    environment = getEnvironment(core);
+
+    const auto governor{getGovernor(core)};
+    if ((governor.compare("performance") != 0) && (governor.compare("unknown") != 0))
+        std::cerr << "\nCPU frequency governor is \"" << governor << "\", timings may vary\n";
+
+    if (getTurbo().compare("on") == 0)
+        std::cerr << "\nCPU turbo is enabled, timings may vary\n";
+
+    if (verbose)
+        std::cout << "Stable timings in environment " << environment << '\n';
+}
+
+/**
+ * Read an on/off environment variable.
+ *
+ * @param  name - name of the environment variable.
+ * @return false if it is not set, is empty or is "0", otherwise true.
+ */
+UNITTEST_INLINE bool UnitTest_c::getFlag(const char * name)
+{
+    const char * value{std::getenv(name)};
+    if ((!value) || (!*value))
+        return false;
+
+    return std::string{value}.compare("0") != 0;
+}
+
+UNITTEST_INLINE bool UnitTest_c::setCount(const std::string & key, size_t count)
 {
     auto it = counts.find(key);
     if (it == counts.end())
@@ -168,23 +495,142 @@ bool UnitTest_c::setCount(const std::string & key, size_t count)
     return false;
 }
 
-void UnitTest_c::complete(void)
+/**
+ * Parse a line of "results.txt".
+ *
+ * @param  line - "count func group", or "count func" for older files.
+ * @param  result - parsed result.
+ * @return true if the line was parsed successfully.
+ */
+UNITTEST_INLINE bool UnitTest_c::parseResult(const std::string & line, Result & result)
 {
-    if (tolerance <= 0.0f)
+    std::istringstream iss{line};
+    size_t count{};
+    std::string func{};
+    std::string grp{};
+
+    if (!(iss >> count >> func))
+        return false;
+
+    // Older files do not record the group, so assume it is a UNIT_TEST.
+    if (!(iss >> grp))
+        grp = func;
+
+    result = Result{func, grp, count};
+
+    return true;
+}
+
+/**
+ * Send a result to the output stream in the format read by parseResult().
+ *
+ * @param  os - Output stream.
+ * @param  result - result to send.
+ */
+UNITTEST_INLINE void UnitTest_c::storeResult(std::ostream &os, const Result & result)
+{
+    const auto & [func, grp, count] = result;
+
+    os << count << " " << func << " " << grp << "\n";
+}
+
+/**
+ * Determine whether a test case should be run when only failing test cases
+ * are selected. A test case is run if it failed previously, if it is new or
+ * if nothing failed previously.
+ *
+ * @param  test - name of the test case passed to RUN_TEST.
+ * @param  results - previous results.
+ * @return true if the test case should be run.
+ */
+UNITTEST_INLINE bool UnitTest_c::isSelected(const std::string & test, const Results & results)
+{
+    bool failing{};
+    bool known{};
+    for (auto & [func, grp, count] : results)
+    {
+        if (grp.compare(test) != 0)
+        {
+            if (count)
+                failing = true;
+
+            continue;
+        }
+
+        if (count)
+            return true;
+
+        known = true;
+    }
+
+    return !failing || !known;
+}
+
+/**
+ * Get the previous results of the test cases, including those defined by
+ * NEXT_CASE, that belong to the given tests.
+ *
+ * @param  results - previous results.
+ * @param  tests - names of the tests passed to RUN_TEST.
+ * @return the results to carry forward.
+ */
+UNITTEST_INLINE UnitTest_c::Results UnitTest_c::getSkipped(const Results & results, const std::vector<std::string> & tests)
+{
+    Results skips{};
+
+    for (auto & result : results)
+        if (std::find(tests.begin(), tests.end(), std::get<1>(result)) != tests.end())
+            skips.push_back(result);
+
+    return skips;
+}
+
+UNITTEST_INLINE void UnitTest_c::run(const std::string & test, void (*func)(void))
+{
+#if !defined(UNITTEST_DISABLE)
+    if ((failingOnly) && (!isSelected(test, previous)))
+    {
+        skipped.push_back(test);
+        assertList.emplace_back(test, skipTestText);
+        if (verbose)
+            std::cout << test << " - skipped, passed previously\n";
+
+        return;
+    }
+#endif
+
+    group = test;
+    if (warmUp)
+    {
+        warming = true;
+        func();
+        warming = false;
+    }
+
+    func();
+    group.clear();
+}
+
+UNITTEST_INLINE void UnitTest_c::complete(void)
+{
+    // Once a test has been skipped, the state it would have set up is missing.
+    if ((tolerance <= 0.0f) || (warming) || (!skipped.empty()))
         return;
 
     const auto stop = std::chrono::steady_clock::now();
     const auto elapsed{stop-start};
     const auto nseconds = elapsed.count();
-    if (setTime(testCase, elapsed))
+    const auto key{getKey(testCase, environment)};
+    if (setTime(key, elapsed))
     {
+        recordEnvironment(key);
         update = true;
         if (verbose)
             std::cout << testCase << " -> " << nseconds << "ns\n";
     }
     else
     {
-        const auto previous = getTime(testCase);
+        const auto previous = getTime(key);
         const auto delta{elapsed - previous};
         const auto change = (float)(delta.count()) / previous.count();
         const auto slower = (delta > std::chrono::nanoseconds{0});
@@ -206,15 +652,16 @@ void UnitTest_c::complete(void)
     }
 }
 
-void UnitTest_c::checking(const std::string & cond)
+UNITTEST_INLINE void UnitTest_c::profile(void)
 {
-    condition = cond;
-    if (profiling)
-        assertList.push_back({testCase, condition});
+    assertList.emplace_back(testCase, condition);
 }
 
-void UnitTest_c::failure(const char *file, int line)
+UNITTEST_INLINE void UnitTest_c::failure(const char *file, int line)
 {
+    if (warming)
+        return;
+
     errors++;
     errorList[testCase]++;
 
@@ -225,13 +672,14 @@ void UnitTest_c::failure(const char *file, int line)
     std::cerr << '\n';
 }
 
-int UnitTest_c::finished(void)
+UNITTEST_INLINE int UnitTest_c::finished(void)
 {
     if (update)
         store();
 
     std::cout << "\nTesting complete.\n";
 
+#if !defined(UNITTEST_DISABLE)
     if (std::ofstream os{profileFileName, std::ios::out})
     {
         std::cout << "Generating test profile in text file " << profileFileName << "\n";
@@ -241,6 +689,7 @@ int UnitTest_c::finished(void)
             if (condition.compare(logTestText) == 0)
                 os << testCase << '\n';
             else
+            if (condition.compare(skipTestText) != 0)
                 os << "  " << condition << '\n';
         }
     }
@@ -249,21 +698,53 @@ int UnitTest_c::finished(void)
     {
         std::cout << "Generating test results in text file " << resultsFileName << "\n";
 
-        // Output in assertList order.
+        // Output in assertList order, carrying forward skipped test cases.
         for (auto & [testCase, condition] : assertList)
         {
             if (condition.compare(logTestText) == 0)
-                os << errorList[testCase] << " " << testCase << "\n";
+                storeResult(os, Result{testCase, groups[testCase], errorList[testCase]});
+            else
+            if (condition.compare(skipTestText) == 0)
+                for (auto & result : getSkipped(previous, { testCase }))
+                    storeResult(os, result);
         }
     }
+#endif
 
     return errors;
 }
 
-int UnitTest_c::summary(void)
+UNITTEST_INLINE int UnitTest_c::summary(void)
 {
     std::cout << "\nTest Result Summary\n";
 
+#if defined(UNITTEST_DISABLE)
+    std::cout << "\nAssertions disabled, so there are no results to compare.\n";
+
+    return errors;
+#endif
+
+    if (const auto count = skipped.size())
+    {
+        std::cout << "\n" << count << " previously passing UNIT_TEST";
+        if (count != 1)
+            std::cout << "s";
+        std::cout << " (and any NEXT_CASEs) skipped, so later timings were not checked.\n";
+    }
+
+    bool fixed{};
+    for (auto & [testCase, condition] : assertList)
+    {
+        if ((condition.compare(logTestText) == 0) && (!errorList[testCase]) && (counts[testCase]))
+        {
+            if (!fixed)
+                std::cout << "\nThe following test cases now pass:\n";
+            fixed = true;
+
+            std::cout << "  " << testCase << "  [" << counts[testCase] << " -> 0] - BETTER than previous test run.\n";
+        }
+    }
+
     if (errors)
     {
         if (errors == 1)
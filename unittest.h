@@ -36,12 +36,13 @@ not exist it is generated. If it does exist, it is read and used to compare
 with the latest test run. This helps indicate if code changes have introduced
 a performance hit.
 
-"results.txt" lists the number of errors each test case has found. This file is
-read on start up and is generated with the latest results every time the tests
-are run. If OUTPUT_SUMMARY is selected, the previous and latest results are
-compared and any changes are displayed indicating whether any test cases have
-better or worse results. This helps when there are a large number of tests with
-a significant percentage failing. This is useful for Test Driven Developement.
+"results.txt" lists the number of errors each test case has found, along with
+the UNIT_TEST that each test case belongs to. This file is read on start up
+and is generated with the latest results every time the tests are run. If
+OUTPUT_SUMMARY is selected, the previous and latest results are compared and
+any changes are displayed indicating whether any test cases have better or
+worse results. This helps when there are a large number of tests with a
+significant percentage failing. This is useful for Test Driven Developement.
 
 "profile.txt" lists the assertions made by each test case. This file is
 generated every time the tests are run.
@@ -83,6 +84,32 @@ To run the test cases use the RUN_TEST(func) macro on all 'func's defined by
 the UNIT_TEST macro only. Do not try to run the 'func's defined by the 
 NEXT_CASE macros as this will cause a compile error.
 
+Re-running failing test cases
+The macros FAILING_ONLY_ON and FAILING_ONLY_OFF control whether RUN_TEST
+skips the test cases that passed on the previous run, as recorded in
+"results.txt". Only the test cases that previously failed, along with any new
+test cases, are run. If nothing failed previously, all test cases are run. The
+results and timings of skipped test cases are carried forward, in their
+original order, into "results.txt" and "timings.txt". "profile.txt" only lists
+the test cases that were run. Setting the environment variable
+UNITTEST_FAILING_ONLY to anything other than "0" has the same effect as
+calling FAILING_ONLY_ON. The state can be tested using IS_FAILING_ONLY.
+
+Note that a skipped test case does not make any state changes it contains, such
+as VERBOSE_OFF or SET_TOLERANCE(value), so the test cases that follow it may
+behave differently than in a full run. For this reason, once a test case has
+been skipped, no further timings are checked or recorded. Failing only runs
+can also hide a newly broken test case for as long as any other test case
+fails, so they should be followed by a full run.
+
+Watch mode
+The 'watch' make target rebuilds the test code every time a file in the
+directory is saved. Only the changed translation units are recompiled. It then
+runs only the previously failing test cases. Once they all pass, the full suite
+is run straight away to catch any regression hidden while they were failing.
+Run 'make && ./test' for a full run at any other time. This requires
+inotifywait (from inotify-tools).
+
 Error count
 The current error count can be obtained with the ERROR_COUNT macro.
 
@@ -117,6 +144,41 @@ timings for the new 'func' names can be calculated.
 
 **If precise timing is required, performance tools should be used.**
 
+Stable timings
+The macros STABLE_TIMINGS_ON and STABLE_TIMINGS_OFF control an opt-in mode for
+machines that are not quiet, such as shared CI runners. Turning it on pins the
+test thread to a single core (the core given by the environment variable
+UNITTEST_CPU, or else the first isolated core, or else the lowest core the
+thread may run on), then checks the CPU frequency governor and turbo state,
+warning if they are likely to skew the timings. Turning it off restores the original affinity. The CPU
+model, core, governor and turbo state form an environment fingerprint which is
+stored, along with the load average, with each entry in "timings.txt". Each
+environment keeps its own baseline, so timings recorded in a different
+environment are never compared or overwritten. Setting the environment
+variable UNITTEST_STABLE to anything other than "0" has the same effect as
+calling STABLE_TIMINGS_ON. The state can be tested using IS_STABLE.
+
+The macros WARM_UP_ON and WARM_UP_OFF control whether RUN_TEST runs each test
+case once, unrecorded, before running it again to be timed. This warms the
+caches but means the test code must tolerate being run twice.
+
+Header-only build
+By default unittest.cpp is compiled and linked separately. Defining the macro
+UNITTEST_HEADER_ONLY before including unittest.h (or on the command line)
+pulls the implementation into the including translation unit as inline
+functions, allowing calls such as checking() and progress() to be inlined into
+the test cases. In this case unittest.cpp must not also be compiled and linked.
+
+Disabling assertions
+Defining the macro UNITTEST_DISABLE compiles REQUIRE(cond) down to simply
+evaluating 'cond'. No assertion is recorded and no error is counted, so the
+same test code can be run as a benchmark. Test case progress and timings are
+still reported, but the timings are tracked in "benchmarks.txt" instead of
+"timings.txt". "results.txt" is neither read nor generated, so no results are
+compared and FAILING_ONLY_ON has no effect, and "profile.txt" is not generated.
+As the implementation must also see UNITTEST_DISABLE, it requires
+UNITTEST_HEADER_ONLY.
+
 Cloning
 To clone this code, execute the following unix/linux commands:
 
@@ -131,6 +193,21 @@ To clone this code, execute the following unix/linux commands:
 #include <unordered_map>
 #include <vector>
 #include <tuple>
+#include <cstdlib>
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+#if defined(UNITTEST_DISABLE) && !defined(UNITTEST_HEADER_ONLY)
+#error "UNITTEST_DISABLE requires UNITTEST_HEADER_ONLY"
+#endif
+
+#if defined(UNITTEST_HEADER_ONLY)
+#define UNITTEST_INLINE inline
+#else
+#define UNITTEST_INLINE
+#endif
 
 /**
  * @section unit test macro definitions.
@@ -145,6 +222,17 @@ To clone this code, execute the following unix/linux commands:
 #define PROFILE_ON UnitTest_c::getInstance().setProfiling(true);
 #define PROFILE_OFF UnitTest_c::getInstance().setProfiling(false);
 
+#define FAILING_ONLY_ON UnitTest_c::getInstance().setFailingOnly(true);
+#define FAILING_ONLY_OFF UnitTest_c::getInstance().setFailingOnly(false);
+#define IS_FAILING_ONLY (UnitTest_c::getInstance().isFailingOnly())
+
+#define STABLE_TIMINGS_ON UnitTest_c::getInstance().setStable(true);
+#define STABLE_TIMINGS_OFF UnitTest_c::getInstance().setStable(false);
+#define IS_STABLE (UnitTest_c::getInstance().isStable())
+
+#define WARM_UP_ON UnitTest_c::getInstance().setWarmUp(true);
+#define WARM_UP_OFF UnitTest_c::getInstance().setWarmUp(false);
+
 #define DEFAULT_TOLERANCE (0.25f)
 #define SET_TOLERANCE(value) UnitTest_c::getInstance().setTolerance(value);
 
@@ -155,17 +243,21 @@ To clone this code, execute the following unix/linux commands:
     UnitTest_c::getInstance().progress(#func, desc);
 
 #define NEXT_CASE(func, desc) \
-    UnitTest_c::getInstance().complete();\
-    UnitTest_c::getInstance().progress(#func, desc);
+    UnitTest_c::complete();\
+    UnitTest_c::progress(#func, desc);
 
 #define END_TEST \
-    UnitTest_c::getInstance().complete();\
+    UnitTest_c::complete();\
 }
 
-#define REQUIRE(cond) { UnitTest_c::getInstance().checking(#cond); \
-    if (!(cond)) UnitTest_c::getInstance().failure(__FILE__, __LINE__); }
+#if defined(UNITTEST_DISABLE)
+#define REQUIRE(cond) { (void)(cond); }
+#else
+#define REQUIRE(cond) { UnitTest_c::checking(#cond); \
+    if (!(cond)) UnitTest_c::failure(__FILE__, __LINE__); }
+#endif
 
-#define RUN_TEST(func)    func();
+#define RUN_TEST(func)    UnitTest_c::getInstance().run(#func, func);
 
 #define ERROR_COUNT UnitTest_c::getInstance().getErrorCount()
 
@@ -181,34 +273,84 @@ To clone this code, execute the following unix/linux commands:
 
 class UnitTest_c
 {
+public:
+//- Results are held as (test case, UNIT_TEST it belongs to, error count).
+    using Result = std::tuple<std::string, std::string, size_t>;
+    using Results = std::vector<Result>;
+
+//- Timings are held as (test case, duration, environment, load average).
+    using Timing = std::tuple<std::string, std::chrono::nanoseconds, std::string, std::string>;
+
 private:
 //- Hide the default constructor and destructor.
-    UnitTest_c(void) { retrieve(); }
+    UnitTest_c(void)
+    {
+        failingOnly = getFlag("UNITTEST_FAILING_ONLY");
+        retrieve();
+        if (getFlag("UNITTEST_STABLE"))
+            setStable(true);
+    }
     virtual ~UnitTest_c(void) {}
 
     void display(std::ostream &os) const;
 
-    static std::string testCase;
-    static std::string description;
-    static std::string condition;
-    static bool update;
-    static bool verbose;
-    static bool profiling;
-    static size_t errors;
-    static float tolerance;
-
-    static std::chrono::time_point<std::chrono::steady_clock> start;
-
-    static std::unordered_map<std::string, std::chrono::nanoseconds> times;
-    static std::unordered_map<std::string, size_t> counts;
-    static std::unordered_map<std::string, size_t> errorList;
-    static std::vector<std::pair<std::string, std::string>> assertList;
+#if defined(UNITTEST_DISABLE)
+    inline static const std::string timingsFileName{"benchmarks.txt"};
+#else
+    inline static const std::string timingsFileName{"timings.txt"};
+#endif
+    inline static const std::string profileFileName{"profile.txt"};
+    inline static const std::string resultsFileName{"results.txt"};
+    inline static const std::string logTestText{"logTest"};
+    inline static const std::string skipTestText{"skipTest"};
+
+    inline static std::string testCase{"UNDEFINED"};
+    inline static std::string description{"UNDEFINED"};
+    inline static const char * condition{"UNDEFINED"};
+    inline static std::string group{};
+    inline static std::string environment{};
+    inline static bool update{};
+    inline static bool verbose{true};
+    inline static bool profiling{true};
+    inline static bool failingOnly{};
+    inline static bool stable{};
+    inline static bool warmUp{};
+    inline static bool warming{};
+    inline static size_t errors{};
+    inline static float tolerance{DEFAULT_TOLERANCE};
+
+    inline static std::chrono::time_point<std::chrono::steady_clock> start{};
+
+#if defined(__linux__)
+    inline static cpu_set_t originalAffinity{};
+    inline static bool affinitySaved{};
+#endif
+
+    inline static std::unordered_map<std::string, std::chrono::nanoseconds> times{};
+    inline static std::unordered_map<std::string, std::string> environments{};
+    inline static std::unordered_map<std::string, std::string> loads{};
+    inline static std::unordered_map<std::string, size_t> counts{};
+    inline static std::unordered_map<std::string, size_t> errorList{};
+    inline static std::vector<std::pair<std::string, std::string>> assertList{};
+    inline static std::unordered_map<std::string, std::string> groups{};
+    inline static Results previous{};
+    inline static std::vector<std::string> skipped{};
 
     static bool store(void);
     static bool retrieve(void);
     static std::chrono::nanoseconds getTime(const std::string & key);
     static bool setTime(const std::string & key, std::chrono::nanoseconds value);
+    static void storeTimes(std::ostream &os, const std::string & test);
+    static void recordEnvironment(const std::string & key);
+    static std::string readValue(const std::string & fileName);
+    static std::string getModel(void);
+    static std::string getGovernor(int core);
+    static std::string getTurbo(void);
+    static int pin(void);
+    static void unpin(void);
     static bool setCount(const std::string & key, size_t count);
+    static bool getFlag(const char * name);
+    static void profile(void);
 
 public:
 //- Delete the copy constructor and assignement operator.
@@ -223,10 +365,26 @@ public:
     static bool isVerbose(void) { return verbose; }
     static void setProfiling(bool state = true) { profiling = state; }
     static bool isProfiling(void) { return profiling; }
+    static void setFailingOnly(bool state = true) { failingOnly = state; }
+    static bool isFailingOnly(void) { return failingOnly; }
+    static void setStable(bool state = true);
+    static bool isStable(void) { return stable; }
+    static void setWarmUp(bool state = true) { warmUp = state; }
+    static bool isWarmUp(void) { return warmUp; }
     static void setTolerance(float value) { tolerance = value; }
+    static void run(const std::string & test, void (*func)(void));
+
+    static bool parseResult(const std::string & line, Result & result);
+    static void storeResult(std::ostream &os, const Result & result);
+    static bool isSelected(const std::string & test, const Results & results);
+    static Results getSkipped(const Results & results, const std::vector<std::string> & tests);
+    static bool parseTiming(const std::string & line, Timing & timing);
+    static void storeTiming(std::ostream &os, const Timing & timing);
+    static std::string getKey(const std::string & test, const std::string & env);
+    static std::string getEnvironment(int core);
     static void progress(const std::string & test, const std::string & desc);
     static void complete(void);
-    static void checking(const std::string & cond);
+    static void checking(const char * cond) { if (warming) return; condition = cond; if (profiling) profile(); }
     static void failure(const char *file, int line);
     static int getErrorCount(void) { return errors; }
     static int finished(void);
@@ -234,5 +392,9 @@ public:
 
 };
 
+#if defined(UNITTEST_HEADER_ONLY)
+#include "unittest.cpp"
+#endif
+
 #endif // !defined(_UNITTEST_H__20210324_0940__INCLUDED_)
 